@@ -0,0 +1,144 @@
+/*
+ * Buddy system allocator used by the scheduler to simulate main memory.
+ * Memory is MEMORY_SIZE bytes. A block of order k is 2^k bytes and starts at a
+ * multiple of its size, so its buddy is found by flipping bit k of its start.
+ *
+ * Every order keeps a doubly linked free list threaded through arrays indexed by
+ * block start, and a bitmap of the orders whose list is not empty. Allocation
+ * finds the smallest big enough order with one bit scan and splits down to the
+ * requested order; freeing merges with free buddies on the way up. Both are
+ * O(log MEMORY_SIZE).
+ */
+
+#ifndef BUDDY_MAX_ORDER
+#define BUDDY_MAX_ORDER 10  // At most 31, freeOrders is one bit per order
+#endif
+#define MEMORY_SIZE (1 << BUDDY_MAX_ORDER)
+
+struct BuddyAllocator {
+    int freeHead[BUDDY_MAX_ORDER + 1];  // First free block of each order, -1 if none
+    int next[MEMORY_SIZE];              // Free list links, indexed by block start
+    int prev[MEMORY_SIZE];
+    signed char order[MEMORY_SIZE];     // Order of the block starting here
+    bool isFree[MEMORY_SIZE];
+    unsigned int freeOrders;            // Bit k is set while freeHead[k] != -1
+};
+
+void buddyPush(struct BuddyAllocator *buddy, int start, int order)
+{
+    buddy->order[start] = order;
+    buddy->isFree[start] = true;
+    buddy->prev[start] = -1;
+    buddy->next[start] = buddy->freeHead[order];
+    if (buddy->freeHead[order] != -1)
+    {
+        buddy->prev[buddy->freeHead[order]] = start;
+    }
+    buddy->freeHead[order] = start;
+    buddy->freeOrders |= 1u << order;
+}
+
+void buddyUnlink(struct BuddyAllocator *buddy, int start)
+{
+    int order = buddy->order[start];
+    if (buddy->prev[start] != -1)
+    {
+        buddy->next[buddy->prev[start]] = buddy->next[start];
+    }
+    else
+    {
+        buddy->freeHead[order] = buddy->next[start];
+    }
+    if (buddy->next[start] != -1)
+    {
+        buddy->prev[buddy->next[start]] = buddy->prev[start];
+    }
+    buddy->isFree[start] = false;
+    if (buddy->freeHead[order] == -1)
+    {
+        buddy->freeOrders &= ~(1u << order);
+    }
+}
+
+/* Start with all of memory as one free block */
+void buddyInit(struct BuddyAllocator *buddy)
+{
+    for (int k = 0; k <= BUDDY_MAX_ORDER; k++)
+    {
+        buddy->freeHead[k] = -1;
+    }
+    for (int i = 0; i < MEMORY_SIZE; i++)
+    {
+        buddy->isFree[i] = false;
+    }
+    buddy->freeOrders = 0;
+    buddyPush(buddy, 0, BUDDY_MAX_ORDER);
+}
+
+/* Smallest order whose block holds size bytes, -1 if it cannot fit in memory at all */
+int buddyOrderFor(int size)
+{
+    int order = 0;
+    while (order <= BUDDY_MAX_ORDER && (1 << order) < size)
+    {
+        order++;
+    }
+    return order <= BUDDY_MAX_ORDER ? order : -1;
+}
+
+/*
+ * Allocate a block for size bytes.
+ * Returns the start of the block, or -1 if no free block is big enough right now.
+ */
+int buddyAlloc(struct BuddyAllocator *buddy, int size)
+{
+    int order = buddyOrderFor(size);
+    if (order == -1)
+    {
+        return -1;
+    }
+    unsigned int candidates = buddy->freeOrders & ~((1u << order) - 1);
+    if (candidates == 0)
+    {
+        return -1;
+    }
+
+    int k = __builtin_ctz(candidates);
+    int start = buddy->freeHead[k];
+    buddyUnlink(buddy, start);
+
+    // Split down to the requested order, freeing the upper half each time
+    while (k > order)
+    {
+        k--;
+        buddyPush(buddy, start + (1 << k), k);
+    }
+    buddy->order[start] = order;
+    return start;
+}
+
+/*
+ * Free the block starting at start, merging it with its buddy while that is free.
+ * Returns the size of the block that was freed.
+ */
+int buddyFree(struct BuddyAllocator *buddy, int start)
+{
+    int order = buddy->order[start];
+    int size = 1 << order;
+    while (order < BUDDY_MAX_ORDER)
+    {
+        int buddyStart = start ^ (1 << order);
+        if (!buddy->isFree[buddyStart] || buddy->order[buddyStart] != order)
+        {
+            break;
+        }
+        buddyUnlink(buddy, buddyStart);
+        if (buddyStart < start)
+        {
+            start = buddyStart;
+        }
+        order++;
+    }
+    buddyPush(buddy, start, order);
+    return size;
+}
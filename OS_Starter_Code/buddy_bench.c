@@ -0,0 +1,110 @@
+/*
+ * Benchmark of the buddy allocator the scheduler uses (buddy.h), at job counts far
+ * beyond what one simulation run sees. It is built with a much larger memory than the
+ * scheduler's and small jobs, so tens of thousands of blocks are live at once.
+ * Each round fills memory with jobs of random sizes until an allocation fails, then
+ * frees them all in random order. Both phases are timed as a whole, and the cost of
+ * reading the clock is measured first and taken off every phase.
+ *
+ * Usage: ./buddy_bench.out [number of jobs, default 1000000]
+ */
+
+#include "headers.h"
+#include <stdbool.h>
+
+#define BUDDY_MAX_ORDER 20  // 1 MiB of memory
+#include "buddy.h"
+
+#define MAX_JOB_SIZE 64
+
+/* Average time elapsedNsec() reports for an empty phase */
+double clockOverheadNsec()
+{
+    long long total = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        struct timespec before;
+        clock_gettime(CLOCK_MONOTONIC, &before);
+        total += elapsedNsec(&before);
+    }
+    return (double)total / 100000;
+}
+
+int main(int argc, char * argv[])
+{
+    long long jobs = argc > 1 ? atoll(argv[1]) : 1000000;
+    if (jobs <= 0)
+    {
+        printf("Number of jobs must be positive\n");
+        return -1;
+    }
+
+    static struct BuddyAllocator buddy;
+    static int live[MEMORY_SIZE];   // Blocks allocated in the current round
+    static int sizes[MEMORY_SIZE];  // Job sizes, drawn once and reused round after round
+    buddyInit(&buddy);
+    srand(1);
+    for (int i = 0; i < MEMORY_SIZE; i++)
+    {
+        sizes[i] = rand() % MAX_JOB_SIZE + 1;
+    }
+
+    double overhead = clockOverheadNsec();
+    long long allocated = 0, failed = 0, freed = 0, phases = 0;
+    long long allocNsec = 0, freeNsec = 0;
+    int maxLive = 0;
+    int next = 0;   // Next job size to use
+    while (allocated < jobs)
+    {
+        // Fill memory until the next job does not fit
+        int count = 0;
+        struct timespec before;
+        clock_gettime(CLOCK_MONOTONIC, &before);
+        while (count < MEMORY_SIZE && allocated + count < jobs)
+        {
+            int start = buddyAlloc(&buddy, sizes[next]);
+            if (start == -1)
+            {
+                break;
+            }
+            next = (next + 1) % MEMORY_SIZE;
+            live[count++] = start;
+        }
+        allocNsec += elapsedNsec(&before);
+        allocated += count;
+        if (count > maxLive)
+        {
+            maxLive = count;
+        }
+        if (allocated < jobs)
+        {
+            failed++;
+        }
+
+        // Free everything in random order, merging back to one block
+        for (int i = count - 1; i > 0; i--)
+        {
+            int j = rand() % (i + 1);
+            int swap = live[i];
+            live[i] = live[j];
+            live[j] = swap;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &before);
+        for (int i = 0; i < count; i++)
+        {
+            buddyFree(&buddy, live[i]);
+        }
+        freeNsec += elapsedNsec(&before);
+        freed += count;
+        phases++;
+    }
+    allocNsec -= (long long)(overhead * phases);
+    freeNsec -= (long long)(overhead * phases);
+
+    printf("Jobs = %lld, sizes 1-%d bytes in %d bytes of memory, up to %d blocks live\n",
+           jobs, MAX_JOB_SIZE, MEMORY_SIZE, maxLive);
+    printf("Allocations = %lld, avg %.1f ns (%lld failed when memory was full)\n",
+           allocated, (double)allocNsec / (allocated + failed), failed);
+    printf("Frees = %lld, avg %.1f ns\n", freed, (double)freeNsec / freed);
+    return 0;
+}
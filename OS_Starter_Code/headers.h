@@ -10,13 +10,45 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 
 typedef short bool;
 #define true 1
-#define false 1
+#define false 0
 
 #define SHKEY 300
 
+// One clock tick is one second of wall time (see clk.c)
+#define CLK_TICK_NSEC 1000000000L
+// How soon to look at the clock again after a timer fired just before it ticked
+#define CLK_RECHECK_NSEC 10000000L
+#define MSGKEY 12345
+
+// Message types carried on the generator -> scheduler queue
+#define ARRIVAL_MTYPE 1     // a new process from the generator
+#define WAKEUP_MTYPE 2      // scheduler poking itself from a signal handler
+#define LAST_ARRIVAL_MTYPE 3    // no more processes are coming
+
+// Most bursts a process can have: CPU, I/O, CPU, ... always starting and ending with CPU
+#define MAX_BURSTS 15
+
+// Structure to store process information
+struct process {
+    int id;
+    int arrivalTime;
+    int runtime;
+    int priority;
+    int memsize;    // bytes of memory the process needs while it is in the system
+    int burstCount;
+    int bursts[MAX_BURSTS];     // alternating CPU and I/O burst lengths, runtime is the CPU total
+};
+
+// Structure for message queue
+struct msgbuffer {
+    long mtype;
+    struct process p;
+};
+
 
 ///==============================
 //don't mess with this variable//
@@ -30,6 +62,14 @@ int getClk()
     return *shmaddr;
 }
 
+/* Nanoseconds of real (not emulated) time since the given CLOCK_MONOTONIC reading */
+long long elapsedNsec(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000000LL + (now.tv_nsec - since->tv_nsec);
+}
+
 
 /*
  * All process call this function at the beginning to establish communication between them and the clock module.
@@ -1,10 +1,17 @@
 #include "headers.h"
 
 int remainingTime;
+volatile sig_atomic_t resumed = 0;
+
+/* SIGCONT: time spent stopped (preempted or blocked on I/O) must not count as running */
+void handleResume(int signum) {
+    resumed = 1;
+}
 
 int main(int argc, char *argv[]) {
     // Initialize the clock connection
     initClk();
+    signal(SIGCONT, handleResume);
 
     // Check that we have the remaining time as argument
     if (argc < 2) {
@@ -13,16 +20,39 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    // Get the remaining time from the command line argument
-    remainingTime = atoi(argv[1]);
+    // Each argument is one CPU burst; the scheduler keeps us stopped for the I/O in between
+    for (int burst = 1; burst < argc; burst++) {
+        if (burst > 1) {
+            // Ask the scheduler to block us for I/O. It stops us, and continues us once the
+            // I/O is over; SIGCONT is held until we wait so that wake-up can't slip past.
+            sigset_t holdResume, previousMask;
+            sigemptyset(&holdResume);
+            sigaddset(&holdResume, SIGCONT);
+            sigprocmask(SIG_BLOCK, &holdResume, &previousMask);
+            resumed = 0;
+            kill(getppid(), SIGUSR1);
+            while (!resumed) {
+                sigsuspend(&previousMask);
+            }
+            sigprocmask(SIG_SETMASK, &previousMask, NULL);
+        }
+
+        // Get the remaining time from the command line argument
+        remainingTime = atoi(argv[burst]);
 
-    // Loop to simulate execution of the process
-    int previousTime = getClk();  // The last time we checked the clock
-    while (remainingTime > 0) {
-        int currentTime = getClk();
-        if (currentTime > previousTime) {
-            remainingTime -= (currentTime - previousTime);
-            previousTime = currentTime;
+        // Loop to simulate execution of the process
+        int previousTime = getClk();  // The last time we checked the clock
+        resumed = 0;
+        while (remainingTime > 0) {
+            int currentTime = getClk();
+            if (resumed) {
+                // currentTime may have been read before we were stopped
+                resumed = 0;
+                previousTime = getClk();
+            } else if (currentTime > previousTime) {
+                remainingTime -= (currentTime - previousTime);
+                previousTime = currentTime;
+            }
         }
     }
 
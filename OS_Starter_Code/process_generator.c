@@ -2,158 +2,69 @@
 #include <string.h>
 #include <stdbool.h>
 #include <sys/msg.h>
+#include <time.h>
+#include "timing_wheel.h"
 
 #define MAX_PROCESSES 100
-#define MSGKEY 12345
-
-// Structure to store process information
-struct process {
-    int id;
-    int arrivalTime;
-    int runtime;
-    int priority;
-};
-
-// Structure for message queue
-struct msgbuffer {
-    long mtype;
-    struct process p;
-};
 
 // Global variables for process storage
 struct process processes[MAX_PROCESSES];
 int processCount = 0;
-
-// Function to clear IPC resources
-void clearResources(int signum) {
-    printf("\nClearing all resources before exit.\n");
-    destroyClk(true);
-    exit(0);
-}
-
-int main(int argc, char * argv[]) {
-    // Handle SIGINT (Ctrl + C) for cleanup purposes
-    signal(SIGINT, clearResources);
-
-    // Step 1: Read input file
-    FILE *inputFile = fopen("processes.txt", "r");
-    if (inputFile == NULL) {
-        perror("Error opening input file");
-        return -1;
-    }
-
-    char line[256];
-    // Ignore comment lines and parse the processes
-    while (fgets(line, sizeof(line), inputFile)) {
-        if (line[0] != '#') {
-            // Parsing non-comment lines to extract process information
-            struct process p;
-            sscanf(line, "%d\t%d\t%d\t%d", &p.id, &p.arrivalTime, &p.runtime, &p.priority);
-            processes[processCount++] = p;
+int msgq_id;
+
+// Processes waiting to be released, keyed by arrival time. The trace doesn't have
+// to be sorted; processes arriving on the same tick are released in trace order.
+struct TimingWheel arrivals;
+struct WheelEntry arrivalEntries[MAX_PROCESSES];
+
+// Parse a burst column like "3,2,4" (CPU 3, I/O 2, CPU 4) into p.
+// Returns false if it is not an odd-length list of positive lengths.
+bool parseBursts(const char *text, struct process *p) {
+    p->burstCount = 0;
+    while (*text != '\0') {
+        char *end;
+        long length = strtol(text, &end, 10);
+        if (end == text || length <= 0 || p->burstCount == MAX_BURSTS) {
+            return false;
+        }
+        p->bursts[p->burstCount++] = (int)length;
+        text = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
         }
     }
-    fclose(inputFile);
-
-    // Step 2: Ask user for the scheduling algorithm
-    int algorithmChoice;
-    printf("Choose the scheduling algorithm:\n");
-    printf("1. Shortest Job First (SJF)\n");
-    printf("2. Preemptive Highest Priority First (PHPF)\n");
-    printf("3. Round Robin (RR)\n");
-    printf("Enter the choice (1-3): ");
-    scanf("%d", &algorithmChoice);
-
-    // For Round Robin, get time quantum
-    int timeQuantum = 0;
-    if (algorithmChoice == 3) {
-        printf("Enter time quantum for Round Robin: ");
-        scanf("%d", &timeQuantum);
-    }
+    return p->burstCount % 2 == 1;
+}
 
-    // Step 3: Initialize and create the clock and scheduler processes
-    pid_t clkPid = fork();
-    if (clkPid == 0) {
-        // Child process for clock
-        execl("./clk.out", "clk.out", NULL);
-        perror("Failed to start clock process");
-        return -1;
-    }
+// Send a process to the scheduler once its arrival time comes
+void releaseProcess(struct WheelEntry *entry) {
+    struct msgbuffer msg;
+    msg.mtype = ARRIVAL_MTYPE;
+    msg.p = processes[entry->id];
 
-    // Start the scheduler process
-    pid_t schedulerPid = fork();
-    if (schedulerPid == 0) {
-        // Child process for scheduler
-        char algoStr[3], quantumStr[3];
-        sprintf(algoStr, "%d", algorithmChoice);
-        sprintf(quantumStr, "%d", timeQuantum);
-        execl("./scheduler.out", "scheduler.out", algoStr, quantumStr, NULL);
-        perror("Failed to start scheduler process");
-        return -1;
+    if (msgsnd(msgq_id, &msg, sizeof(msg.p), !IPC_NOWAIT) == -1) {
+        perror("Error sending message to scheduler");
+    } else {
+        printf("Sent process %d to scheduler at time %d\n", msg.p.id, getClk());
     }
+}
 
-    // Step 4: Initialize clock to start tracking time
-    initClk();
-
-    // Step 5: Create message queue for IPC with scheduler
-    int msgq_id = msgget(MSGKEY, IPC_CREAT | 0644);
-    if (msgq_id == -1) {
-        perror("Error in creating message queue");
-        return -1;
+// Sleep until the clock reaches the given tick
+void sleepUntilTick(long long tick) {
+    long long ticks = tick - getClk();
+    if (ticks > 0) {
+        struct timespec wait;
+        wait.tv_sec = ticks * CLK_TICK_NSEC / 1000000000LL;
+        wait.tv_nsec = ticks * CLK_TICK_NSEC % 1000000000LL;
+        nanosleep(&wait, NULL);
     }
 
-    // Step 6: Generation Main Loop - Send processes to the scheduler at the right time
-    int currentProcess = 0;
-    while (currentProcess < processCount) {
-        int currentTime = getClk();
-
-        // Check if any processes have arrived at the current time
-        while (currentProcess < processCount && processes[currentProcess].arrivalTime <= currentTime) {
-            // Send the process to the scheduler
-            struct msgbuffer msg;
-            msg.mtype = 1;  // Arbitrary message type, all processes have the same type for simplicity
-            msg.p = processes[currentProcess];
-
-            if (msgsnd(msgq_id, &msg, sizeof(msg.p), !IPC_NOWAIT) == -1) {
-                perror("Error sending message to scheduler");
-            } else {
-                printf("Sent process %d to scheduler at time %d\n", processes[currentProcess].id, currentTime);
-            }
-            currentProcess++;
-        }
-        // Sleep to avoid busy waiting
-        sleep(1);
+    // We may wake up a little ahead of the clock
+    struct timespec recheck = {0, CLK_RECHECK_NSEC};
+    while (getClk() < tick) {
+        nanosleep(&recheck, NULL);
     }
-
-    // Step 7: Clean up and release clock resources
-    destroyClk(true);
-
-    return 0;
 }
-#include "headers.h"
-#include <string.h>
-#include <stdbool.h>
-#include <sys/msg.h>
-
-#define MAX_PROCESSES 100
-#define MSGKEY 12345
-
-// Structure to store process information
-struct process {
-    int id;
-    int arrivalTime;
-    int runtime;
-    int priority;
-};
-
-// Structure for message queue
-struct msgbuffer {
-    long mtype;
-    struct process p;
-};
-
-// Global variables for process storage
-struct process processes[MAX_PROCESSES];
-int processCount = 0;
 
 // Function to clear IPC resources
 void clearResources(int signum) {
@@ -176,10 +87,34 @@ int main(int argc, char * argv[]) {
     char line[256];
     // Ignore comment lines and parse the processes
     while (fgets(line, sizeof(line), inputFile)) {
-        if (line[0] != '#') {
+        if (line[0] != '#' && processCount == MAX_PROCESSES) {
+            printf("Too many processes, only the first %d are used\n", MAX_PROCESSES);
+            break;
+        } else if (line[0] != '#') {
             // Parsing non-comment lines to extract process information
             struct process p;
-            sscanf(line, "%d\t%d\t%d\t%d", &p.id, &p.arrivalTime, &p.runtime, &p.priority);
+            char burstText[128];
+            // Older traces have no memsize or bursts column: no memory, one CPU burst
+            int fields = sscanf(line, "%d\t%d\t%d\t%d\t%d\t%127s", &p.id, &p.arrivalTime, &p.runtime,
+                                &p.priority, &p.memsize, burstText);
+            if (fields < 5) {
+                p.memsize = 0;
+            }
+            if (fields < 6 || !parseBursts(burstText, &p)) {
+                if (fields == 6) {
+                    printf("Process %d: bad burst list \"%s\", using a single CPU burst\n", p.id, burstText);
+                }
+                p.burstCount = 1;
+                p.bursts[0] = p.runtime;
+            }
+            int cpuTotal = 0;
+            for (int b = 0; b < p.burstCount; b += 2) {
+                cpuTotal += p.bursts[b];
+            }
+            if (cpuTotal != p.runtime) {
+                printf("Process %d: runtime %d does not match its CPU bursts, using %d\n", p.id, p.runtime, cpuTotal);
+                p.runtime = cpuTotal;
+            }
             processes[processCount++] = p;
         }
     }
@@ -194,11 +129,23 @@ int main(int argc, char * argv[]) {
     printf("Enter the choice (1-3): ");
     scanf("%d", &algorithmChoice);
 
-    // For Round Robin, get time quantum
-    int timeQuantum = 0;
-    if (algorithmChoice == 3) {
+    // Shadow mode also simulates every algorithm on the same arrivals and compares them
+    int shadowMode = 0;
+    printf("Compare all algorithms in shadow mode? (1 = yes, 0 = no): ");
+    scanf("%d", &shadowMode);
+
+    // For Round Robin, get time quantum (in clock ticks, fractions are rounded up to a whole tick)
+    double timeQuantum = 0;
+    if (algorithmChoice == 3 || shadowMode) {
         printf("Enter time quantum for Round Robin: ");
-        scanf("%d", &timeQuantum);
+        scanf("%lf", &timeQuantum);
+    }
+
+    // For PHPF, get how fast waiting processes age
+    int agingInterval = 0;
+    if (algorithmChoice == 2 || shadowMode) {
+        printf("Enter aging interval for PHPF (ticks waited per priority level, 0 for no aging): ");
+        scanf("%d", &agingInterval);
     }
 
     // Step 3: Initialize and create the clock and scheduler processes
@@ -214,10 +161,17 @@ int main(int argc, char * argv[]) {
     pid_t schedulerPid = fork();
     if (schedulerPid == 0) {
         // Child process for scheduler
-        char algoStr[3], quantumStr[3];
+        char algoStr[3], quantumStr[32], agingStr[12], shadowStr[3];
         sprintf(algoStr, "%d", algorithmChoice);
-        sprintf(quantumStr, "%d", timeQuantum);
-        execl("./scheduler.out", "scheduler.out", algoStr, quantumStr, NULL);
+        sprintf(quantumStr, "%g", timeQuantum);
+        sprintf(agingStr, "%d", agingInterval);
+        sprintf(shadowStr, "%d", shadowMode != 0);
+        // Prefer the scheduler built for this algorithm, fall back to the generic one
+        const char *specializedSchedulers[] = {NULL, "./scheduler_sjf.out", "./scheduler_phpf.out", "./scheduler_rr.out"};
+        if (algorithmChoice >= 1 && algorithmChoice <= 3) {
+            execl(specializedSchedulers[algorithmChoice], "scheduler.out", algoStr, quantumStr, agingStr, shadowStr, NULL);
+        }
+        execl("./scheduler.out", "scheduler.out", algoStr, quantumStr, agingStr, shadowStr, NULL);
         perror("Failed to start scheduler process");
         return -1;
     }
@@ -226,36 +180,38 @@ int main(int argc, char * argv[]) {
     initClk();
 
     // Step 5: Create message queue for IPC with scheduler
-    int msgq_id = msgget(MSGKEY, IPC_CREAT | 0644);
+    msgq_id = msgget(MSGKEY, IPC_CREAT | 0644);
     if (msgq_id == -1) {
         perror("Error in creating message queue");
         return -1;
     }
 
     // Step 6: Generation Main Loop - Send processes to the scheduler at the right time
-    int currentProcess = 0;
-    while (currentProcess < processCount) {
-        int currentTime = getClk();
-
-        // Check if any processes have arrived at the current time
-        while (currentProcess < processCount && processes[currentProcess].arrivalTime <= currentTime) {
-            // Send the process to the scheduler
-            struct msgbuffer msg;
-            msg.mtype = 1;  // Arbitrary message type, all processes have the same type for simplicity
-            msg.p = processes[currentProcess];
-
-            if (msgsnd(msgq_id, &msg, sizeof(msg.p), !IPC_NOWAIT) == -1) {
-                perror("Error sending message to scheduler");
-            } else {
-                printf("Sent process %d to scheduler at time %d\n", processes[currentProcess].id, currentTime);
-            }
-            currentProcess++;
+    wheelInit(&arrivals, getClk());
+    for (int i = 0; i < processCount; i++) {
+        arrivalEntries[i].id = i;
+        wheelInsert(&arrivals, &arrivalEntries[i], processes[i].arrivalTime);
+    }
+    while (true) {
+        // Release everything due by now, then sleep until the next arrival
+        wheelAdvance(&arrivals, getClk(), releaseProcess);
+        if (arrivals.count == 0) {
+            break;
         }
-        // Sleep to avoid busy waiting
-        sleep(1);
+        sleepUntilTick(wheelNextExpiry(&arrivals));
+    }
+
+    // Step 7: Tell the scheduler no more processes are coming. It ends the simulation
+    // (and us with it) once every process has finished.
+    struct msgbuffer last;
+    last.mtype = LAST_ARRIVAL_MTYPE;
+    if (msgsnd(msgq_id, &last, sizeof(last.p), !IPC_NOWAIT) == -1) {
+        perror("Error sending message to scheduler");
+    } else {
+        waitpid(schedulerPid, NULL, 0);
     }
 
-    // Step 7: Clean up and release clock resources
+    // Clean up and release clock resources
     destroyClk(true);
 
     return 0;
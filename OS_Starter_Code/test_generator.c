@@ -9,6 +9,8 @@ struct processData
     int priority;
     int runningtime;
     int id;
+    int memsize;
+    int iotime;
 };
 
 int main(int argc, char * argv[])
@@ -21,7 +23,7 @@ int main(int argc, char * argv[])
     scanf("%d", &no);
     srand(time(null));
     //fprintf(pFile,"%d\n",no);
-    fprintf(pFile, "#id arrival runtime priority\n");
+    fprintf(pFile, "#id arrival runtime priority memsize bursts\n");
     pData.arrivaltime = 1;
     for (int i = 1 ; i <= no ; i++)
     {
@@ -29,9 +31,21 @@ int main(int argc, char * argv[])
         //[min-max] = rand() % (max_number + 1 - minimum_number) + minimum_number
         pData.id = i;
         pData.arrivaltime += rand() % (11); //processes arrives in order
-        pData.runningtime = rand() % (30);
+        pData.runningtime = rand() % (29) + 1;
         pData.priority = rand() % (11);
-        fprintf(pFile, "%d\t%d\t%d\t%d\n", pData.id, pData.arrivaltime, pData.runningtime, pData.priority);
+        pData.memsize = rand() % (256) + 1;
+        fprintf(pFile, "%d\t%d\t%d\t%d\t%d\t", pData.id, pData.arrivaltime, pData.runningtime, pData.priority, pData.memsize);
+        //about half of the processes split their CPU time around one I/O burst of 1-5
+        pData.iotime = (rand() % 2) ? rand() % (5) + 1 : 0;
+        if (pData.runningtime >= 2 && pData.iotime > 0)
+        {
+            int firstBurst = rand() % (pData.runningtime - 1) + 1;
+            fprintf(pFile, "%d,%d,%d\n", firstBurst, pData.iotime, pData.runningtime - firstBurst);
+        }
+        else
+        {
+            fprintf(pFile, "%d\n", pData.runningtime);
+        }
     }
     fclose(pFile);
 }
@@ -0,0 +1,207 @@
+/*
+ * Hierarchical timing wheel, counting in clock ticks.
+ * There are WHEEL_LEVELS wheels of WHEEL_SLOTS slots each, and a level l slot spans
+ * WHEEL_SLOTS^l ticks. An entry goes on the lowest level that reaches its expiry
+ * time. Each time a level wraps around, the next slot of the level above is
+ * cascaded down into it.
+ *
+ * Insert and cancel are O(1). Advancing costs O(1) per tick plus O(1) per entry
+ * that expires or is cascaded, however many entries are waiting.
+ *
+ * Entries are embedded by the caller (the wheel never allocates), and entries
+ * inserted together with the same expiry time fire in insertion order.
+ */
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_HORIZON (1LL << (WHEEL_BITS * WHEEL_LEVELS))
+
+struct WheelEntry
+{
+    long long expires;
+    int id;     // Left to the caller, e.g. an index into its own table
+    struct WheelEntry *next;
+    struct WheelEntry *prev;
+};
+
+struct TimingWheel
+{
+    long long now;                                      // Last tick advanced to
+    struct WheelEntry slots[WHEEL_LEVELS][WHEEL_SLOTS]; // List heads of each slot
+    struct WheelEntry due;                              // Already expired when inserted
+    int count;
+};
+
+void wheelListInit(struct WheelEntry *head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+void wheelListAppend(struct WheelEntry *head, struct WheelEntry *entry)
+{
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+}
+
+void wheelListUnlink(struct WheelEntry *entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->next = entry;
+    entry->prev = entry;
+}
+
+void wheelInit(struct TimingWheel *wheel, long long now)
+{
+    wheel->now = now;
+    wheel->count = 0;
+    wheelListInit(&wheel->due);
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+    {
+        for (int s = 0; s < WHEEL_SLOTS; s++)
+        {
+            wheelListInit(&wheel->slots[l][s]);
+        }
+    }
+}
+
+/* Put an entry on the slot for its expiry time, without touching the count */
+void wheelPlace(struct TimingWheel *wheel, struct WheelEntry *entry)
+{
+    long long delay = entry->expires - wheel->now;
+    if (delay <= 0)
+    {
+        wheelListAppend(&wheel->due, entry);
+        return;
+    }
+
+    long long expires = entry->expires;
+    if (delay >= WHEEL_HORIZON)
+    {
+        // Too far out, park it on the last top level slot; it is re-placed when cascaded
+        expires = wheel->now + WHEEL_HORIZON - 1;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delay >= (1LL << (WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+    int slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    wheelListAppend(&wheel->slots[level][slot], entry);
+}
+
+/* Schedule an entry to fire at tick expires */
+void wheelInsert(struct TimingWheel *wheel, struct WheelEntry *entry, long long expires)
+{
+    entry->expires = expires;
+    wheelPlace(wheel, entry);
+    wheel->count++;
+}
+
+/* Cancel an entry that has not fired yet */
+void wheelRemove(struct TimingWheel *wheel, struct WheelEntry *entry)
+{
+    wheelListUnlink(entry);
+    wheel->count--;
+}
+
+/* Hand every entry of a list to fire(), in order. fire() may insert it again. */
+void wheelFireList(struct TimingWheel *wheel, struct WheelEntry *head, void (*fire)(struct WheelEntry *entry))
+{
+    while (head->next != head)
+    {
+        struct WheelEntry *entry = head->next;
+        wheelListUnlink(entry);
+        wheel->count--;
+        fire(entry);
+    }
+}
+
+/* Move the clock forward to tick to, calling fire() for each entry that expires */
+void wheelAdvance(struct TimingWheel *wheel, long long to, void (*fire)(struct WheelEntry *entry))
+{
+    wheelFireList(wheel, &wheel->due, fire);
+    while (wheel->now < to)
+    {
+        if (wheel->count == 0)
+        {
+            wheel->now = to;
+            break;
+        }
+        wheel->now++;
+
+        // Find the highest level this tick starts a new slot of, and cascade from there down
+        int top = 0;
+        while (top < WHEEL_LEVELS - 1 && (wheel->now & ((1LL << (WHEEL_BITS * (top + 1))) - 1)) == 0)
+        {
+            top++;
+        }
+        for (int l = top; l > 0; l--)
+        {
+            struct WheelEntry *head = &wheel->slots[l][(wheel->now >> (WHEEL_BITS * l)) & WHEEL_MASK];
+            struct WheelEntry pending;
+            wheelListInit(&pending);
+            while (head->next != head)
+            {
+                struct WheelEntry *entry = head->next;
+                wheelListUnlink(entry);
+                wheelListAppend(&pending, entry);
+            }
+            while (pending.next != &pending)
+            {
+                struct WheelEntry *entry = pending.next;
+                wheelListUnlink(entry);
+                wheelPlace(wheel, entry);
+            }
+        }
+
+        wheelFireList(wheel, &wheel->slots[0][wheel->now & WHEEL_MASK], fire);
+        wheelFireList(wheel, &wheel->due, fire);
+    }
+}
+
+/*
+ * Earliest tick at which something may fire, or -1 if the wheel is empty.
+ * Exact for entries less than WHEEL_SLOTS ticks away; for later ones it is the start
+ * of their slot, so advancing to it and asking again is always safe.
+ */
+long long wheelNextExpiry(struct TimingWheel *wheel)
+{
+    if (wheel->count == 0)
+    {
+        return -1;
+    }
+    if (wheel->due.next != &wheel->due)
+    {
+        return wheel->now;
+    }
+
+    long long next = -1;
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+    {
+        int shift = WHEEL_BITS * l;
+        long long base = wheel->now >> shift;
+        for (int k = 1; k <= WHEEL_SLOTS; k++)
+        {
+            if (wheel->slots[l][(base + k) & WHEEL_MASK].next != &wheel->slots[l][(base + k) & WHEEL_MASK])
+            {
+                long long start = (base + k) << shift;
+                if (start <= wheel->now)
+                {
+                    start = wheel->now + 1;
+                }
+                if (next == -1 || start < next)
+                {
+                    next = start;
+                }
+                break;
+            }
+        }
+    }
+    return next;
+}